@@ -11,17 +11,58 @@
 //
 //  node Ha Hartree  // define a node
 //  edge meV 0.001 eV FALSE  // define an edge
+//  edge J/g 1.0 J/mol FALSE molar_mass  // edge with a parameter
 //
 //  The current directory is first searched for a convert.def file
 //  if none is found, the file HOME/bin/convert.def is searched
 //
+//  If the environment variable CV_PROFILE names a file, the number of
+//  queries of each unit is accumulated in that file, and units are
+//  ordered by decreasing query count so that frequently used units
+//  are found first in the unit list. Concurrent runs merge their
+//  counts under a lock on the file CV_PROFILE.lock
+//
 //  use: convert 25 meV K
 //  converts from meV to Kelvin
 //
+//  use: convert 100 kJ/mol J/g molar_mass=18.015
+//  parameters of the edges used in a conversion are given as name=value
+//
+//  use: convert --bin --from Ha --to eV infile outfile
+//  converts a binary file of doubles from Hartree to eV
+//  --to may be repeated, with one output file per target unit:
+//  convert --bin --from Ha --to eV --to K infile out_eV out_K
+//  parameters are read from binary files, one value per record:
+//  convert --bin --from J/mol --to J/g --param molar_mass mm.bin in out
+//
+//  use: convert --npy --from Ha --to eV in.npy [out.npy]
+//  converts a float32 or float64 NumPy array file, in place if no
+//  output file is given
+//
+//  use: convert --cvc-pack out.cvc e:Ha:f8:e.bin x:Bohr:f4:x.bin
+//  writes a column file with unit-tagged columns from raw arrays
+//  (the unit - marks a column without unit, e.g. a count; columns
+//  named as edge parameters supply parameter values and must be f8)
+//  use: convert --cvc-list file.cvc
+//  use: convert --cvc --to eV --to Ang in.cvc [out.cvc]
+//  converts each column to the first compatible unit given with --to
+//
+//  use: convert --xml --map atom/position Bohr Ang --map unit_cell@a Bohr Ang
+//               infile outfile
+//  copies an XML file, converting the numbers in the content of the
+//  elements atom/position and in the attribute a of unit_cell elements
+//
+//  use: convert --complete k --compatible-with eV
+//  lists the units starting with k that can be converted to eV
+//  (used by the shell completion scripts cv-completion.bash and _cv)
+//
 //  constants in .def file from:
 //  Physics Vade Mecum, ed. by H.L.Anderson, AIP (1981)
 //
-//  compilation: g++ -o cv convert.C
+//  compilation: g++ -fopenmp -o cv convert.C
+//  MPI version: mpicxx -fopenmp -DUSE_MPI -o cv_mpi convert.cpp
+//  (-fopenmp threads the conversion loops)
+//  (binary files are then split among tasks and accessed with MPI-IO)
 //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -30,34 +71,130 @@
 #include<cstdlib>
 #include<cstdio>
 #include<cstring>
+#include<cctype>
+#include<stdint.h>
 #include<sys/stat.h>
+#include<sys/file.h>
+#include<sys/mman.h>
+#include<fcntl.h>
+#include<unistd.h>
+#ifdef USE_MPI
+#include<mpi.h>
+#endif
 using namespace std;
 
 #define TRUE 1
 #define FALSE 0
 
 struct node { char *name; char *long_name; struct edge *adj_list;
-              int visited; struct node *next; };
+              int visited; int comp; long count; long nquery;
+              struct node *next; };
+// if param >= 0, the factor is multiplied by the value of that
+// parameter raised to the power ppow (+1 or -1)
 struct edge { struct node *to_node; double factor;
-              int inverse; struct edge *next; };
+              int inverse; int param; int ppow; struct edge *next; };
+
+// maximum number of edge parameters
+#define MAXPARAM 8
+
+// a plan maps x to s*x, or to s/x if inverse is set, where s is factor
+// times the product of the parameters raised to the powers power[]
+struct plan { double factor; int inverse; int power[MAXPARAM]; };
+
+// number of values converted per block in binary mode
+#define NCHUNK (1<<20)
+
+// XML mode: input buffer size, maximum element depth and path length
+#define XML_BUFSIZE (1<<20)
+#define XML_MAXDEPTH 256
+#define XML_MAXPATH 16
+// a map converts the numbers found at the end of an element path,
+// in the element content or in the attribute attr if not NULL
+struct xml_map { int nelem; char *elem[XML_MAXPATH]; char *attr;
+                 struct plan p; };
+
+// column file: a header, a table of columns, and the column payloads
+// at offsets that are multiples of CVC_ALIGN, in native byte order
+#define CVC_MAGIC "CVCOL01"
+#define CVC_ALIGN 4096
+#define CVC_NAMELEN 32
+#define CVC_NOUNIT "-"
+struct cvc_header { char magic[8]; int32_t byteorder; int32_t ncols;
+                    int64_t nrows; };
+struct cvc_column { char name[CVC_NAMELEN]; char unit[CVC_NAMELEN];
+                    char dtype[8]; int64_t offset; };
 
 FILE *defFile;
 char *homedir,defFileName[64];
 double convfac;
 int    invflag;
 char line[256],type[32],shortname[32],longname[32],
-     from_name[32],to_name[32],invstr[32];
+     from_name[32],to_name[32],invstr[32],paramstr[32];
+
+char   param_name[MAXPARAM][32];
+char   param_unit[MAXPARAM][32];
+int    nparam = 0;
+int    param_given[MAXPARAM];
+double param_value[MAXPARAM];
 
 double value, result;
 int    found;
+struct plan plan_result;
 
 struct node *unit_list = NULL;
+char *profile = NULL;
+int mype = 0;
+
+FILE *xml_in, *xml_out;
+char *xml_out_name;
+char *xml_buf, *xml_tbuf = NULL;
+size_t xml_pos, xml_len, xml_tlen, xml_tcap = 0;
+char *xml_stack[XML_MAXDEPTH];
+int xml_depth;
+struct xml_map *xml_maps;
+int xml_nmaps;
 
 void add_node( char *new_name, char *new_long_name );
-void add_edge( char *name1, double fac12, char *name2, int inversion );
+void add_edge( char *name1, double fac12, char *name2, int inversion,
+               char *param );
+int  find_param ( char *name );
+int  add_param ( char *name, char *unit );
 double convert( double value, char *from_unit, char *to_unit );
-void connect ( struct node *n1, struct node *n2, double val );
 struct node *find_node ( char *name, struct node *list );
+void reset_visited ( void );
+int  same_file ( char *file1, char *file2 );
+void make_plan( char *from_unit, char *to_unit, struct plan *p );
+int  find_plan ( struct node *fu, struct node *tu, struct plan *p );
+int  missing_param ( struct plan *p );
+void connect_plan ( struct node *n1, struct node *n2, struct plan p );
+void apply_plans( struct plan *p, int np, const double *x, double **y,
+                  double **prm, long n );
+void convert_bin( char *from_unit, int nto, char **to_units,
+                  char *in_file, char **out_files, char **param_files );
+void label_component ( struct node *n, int comp );
+int  label_components ( void );
+int  compare_names ( const void *a, const void *b );
+void complete( char *prefix, char *compat_unit );
+void read_counts( char *file );
+void read_profile( char *file );
+void write_profile( char *file );
+int  xml_fill ( void );
+int  xml_getc ( void );
+void xml_putc ( int c );
+int  xml_text ( int keep );
+struct xml_map *xml_match ( char *attr );
+void xml_convert_text ( char *s, size_t n, struct plan *p );
+void xml_start_tag ( void );
+void convert_xml( int nmaps, char **paths, char **from_units, char **to_units,
+                  char *in_file, char *out_file );
+void convert_npy( char *from_unit, char *to_unit,
+                  char *in_file, char *out_file );
+void convert_array( struct plan *p, unsigned char *x, unsigned char *y,
+                    size_t itemsize, int swap, double **prm, size_t n );
+void pack_cvc( int ncols, char **specs, char *out_file );
+unsigned char *map_cvc( char *file, int writable, size_t *size );
+void list_cvc( char *file );
+void convert_cvc( int nto, char **to_units, char *in_file, char *out_file );
 
 int main( int argc, char **argv )
 {
@@ -114,7 +251,7 @@ int main( int argc, char **argv )
       else
       {
         sscanf(line,"%s",type);
-        // define node or edge
+        // define node, edge or parameter
         if ( !strcmp(type,"node") )
         {
           sscanf(line,"%s %s %s",type,shortname,longname);
@@ -127,7 +264,8 @@ int main( int argc, char **argv )
         }
         else if ( !strcmp(type,"edge") )
         {
-          sscanf(line,"%s %s %lf %s %s",type,from_name,&convfac,to_name,invstr);
+          int nfields = sscanf(line,"%s %s %lf %s %s %s",type,from_name,
+                               &convfac,to_name,invstr,paramstr);
 #ifdef DEBUG
           cerr << " defining conversion from "
                << from_name << " to " << to_name
@@ -141,7 +279,18 @@ int main( int argc, char **argv )
             exit(1);
           }
           invflag = !strcmp(invstr,"INVERT");
-          add_edge ( from_name, convfac, to_name, invflag );
+          add_edge ( from_name, convfac, to_name, invflag,
+                     nfields == 6 ? paramstr : NULL );
+        }
+        else if ( !strcmp(type,"param") )
+        {
+          sscanf(line,"%s %s %s",type,paramstr,shortname);
+#ifdef DEBUG
+          cerr << " defining parameter "
+               << paramstr << " "
+               << shortname << endl;
+#endif
+          add_param(paramstr,shortname);
         }
         else
         {
@@ -152,11 +301,196 @@ int main( int argc, char **argv )
     }
   }
 
+  profile = getenv("CV_PROFILE");
+  if ( profile )
+    read_profile( profile );
+
+  if ( argc > 2 && !strcmp(argv[1],"--complete") )
+  {
+    // completion mode: cv --complete prefix [--compatible-with unit]
+    char *compat_unit = NULL;
+    if ( argc > 4 && !strcmp(argv[3],"--compatible-with") )
+      compat_unit = argv[4];
+    complete( argv[2], compat_unit );
+    return ( EXIT_SUCCESS );
+  }
+
+  if ( argc > 1 && !strcmp(argv[1],"--bin") )
+  {
+    // binary mode: cv --bin --from unit --to unit [--to unit ...]
+    //                 infile outfile [outfile ...]
+    from_unit = NULL;
+    char **to_units = ( char ** ) malloc ( argc * sizeof( char * ) );
+    char **files = ( char ** ) malloc ( argc * sizeof( char * ) );
+    char *param_files[MAXPARAM];
+    int nto = 0, nfiles = 0;
+    for ( int i = 2; i < argc; i++ )
+    {
+      if ( !strcmp(argv[i],"--from") && i+1 < argc )
+        from_unit = argv[++i];
+      else if ( !strcmp(argv[i],"--to") && i+1 < argc )
+        to_units[nto++] = argv[++i];
+      else if ( !strcmp(argv[i],"--param") && i+2 < argc )
+      {
+        int ip = find_param( argv[i+1] );
+        if ( ip < 0 )
+        {
+          cerr << " cv: unknown parameter " << argv[i+1] << endl;
+          exit ( EXIT_FAILURE );
+        }
+        param_given[ip] = TRUE;
+        param_files[ip] = argv[i+2];
+        i += 2;
+      }
+      else
+        files[nfiles++] = argv[i];
+    }
+    if ( !from_unit || nto == 0 || nfiles != nto + 1 )
+    {
+      cerr << " use: cv --bin --from unit --to unit [--to unit ...]"
+           << " [--param name file ...] infile outfile [outfile ...]"
+           << endl;
+      exit ( EXIT_FAILURE );
+    }
+    convert_bin( from_unit, nto, to_units, files[0], files+1, param_files );
+    free( to_units );
+    free( files );
+    if ( profile && mype == 0 )
+      write_profile( profile );
+    return ( EXIT_SUCCESS );
+  }
+
+  if ( argc > 1 && !strcmp(argv[1],"--npy") )
+  {
+    // NumPy mode: cv --npy --from unit --to unit infile [outfile]
+    // a single target unit is allowed
+    from_unit = to_unit = NULL;
+    char *files[2] = { NULL, NULL };
+    int nfiles = 0, nto = 0;
+    for ( int i = 2; i < argc; i++ )
+    {
+      if ( !strcmp(argv[i],"--from") && i+1 < argc )
+        from_unit = argv[++i];
+      else if ( !strcmp(argv[i],"--to") && i+1 < argc )
+      {
+        to_unit = argv[++i];
+        nto++;
+      }
+      else if ( nfiles < 2 )
+        files[nfiles++] = argv[i];
+      else
+        nfiles++;
+    }
+    if ( !from_unit || nto != 1 || nfiles < 1 || nfiles > 2 )
+    {
+      cerr << " use: cv --npy --from unit --to unit infile [outfile]"
+           << endl;
+      exit ( EXIT_FAILURE );
+    }
+    convert_npy( from_unit, to_unit, files[0], files[1] );
+    if ( profile )
+      write_profile( profile );
+    return ( EXIT_SUCCESS );
+  }
+
+  if ( argc > 3 && !strcmp(argv[1],"--cvc-pack") )
+  {
+    // column file mode: cv --cvc-pack outfile name:unit:dtype:file ...
+    pack_cvc( argc-3, argv+3, argv[2] );
+    return ( EXIT_SUCCESS );
+  }
+
+  if ( argc == 3 && !strcmp(argv[1],"--cvc-list") )
+  {
+    list_cvc( argv[2] );
+    return ( EXIT_SUCCESS );
+  }
+
+  if ( argc > 1 && !strcmp(argv[1],"--cvc") )
+  {
+    // column file mode: cv --cvc --to unit [--to unit ...] infile [outfile]
+    char **to_units = ( char ** ) malloc ( argc * sizeof( char * ) );
+    char *files[2] = { NULL, NULL };
+    int nto = 0, nfiles = 0;
+    for ( int i = 2; i < argc; i++ )
+    {
+      if ( !strcmp(argv[i],"--to") && i+1 < argc )
+        to_units[nto++] = argv[++i];
+      else if ( nfiles < 2 )
+        files[nfiles++] = argv[i];
+      else
+        nfiles++;
+    }
+    if ( nto == 0 || nfiles < 1 || nfiles > 2 )
+    {
+      cerr << " use: cv --cvc --to unit [--to unit ...] infile [outfile]"
+           << endl;
+      exit ( EXIT_FAILURE );
+    }
+    convert_cvc( nto, to_units, files[0], files[1] );
+    free( to_units );
+    if ( profile )
+      write_profile( profile );
+    return ( EXIT_SUCCESS );
+  }
+
+  if ( argc > 1 && !strcmp(argv[1],"--xml") )
+  {
+    // XML mode: cv --xml --map path from_unit to_unit [--map ...]
+    //                infile outfile
+    char **paths = ( char ** ) malloc ( argc * sizeof( char * ) );
+    char **from_units = ( char ** ) malloc ( argc * sizeof( char * ) );
+    char **to_units = ( char ** ) malloc ( argc * sizeof( char * ) );
+    char *files[2];
+    int nmaps = 0, nfiles = 0;
+    for ( int i = 2; i < argc; i++ )
+    {
+      if ( !strcmp(argv[i],"--map") && i+3 < argc )
+      {
+        paths[nmaps] = argv[i+1];
+        from_units[nmaps] = argv[i+2];
+        to_units[nmaps] = argv[i+3];
+        nmaps++;
+        i += 3;
+      }
+      else if ( nfiles < 2 )
+        files[nfiles++] = argv[i];
+      else
+        nfiles++;
+    }
+    if ( nmaps == 0 || nfiles != 2 )
+    {
+      cerr << " use: cv --xml --map path from_unit to_unit [--map ...]"
+           << " infile outfile" << endl;
+      exit ( EXIT_FAILURE );
+    }
+    convert_xml( nmaps, paths, from_units, to_units, files[0], files[1] );
+    free( paths );
+    free( from_units );
+    free( to_units );
+    if ( profile )
+      write_profile( profile );
+    return ( EXIT_SUCCESS );
+  }
+
   if ( argc < 4 )
   {
     cerr << " cv: unit conversions: " << endl;
         cerr << " Current definition file is " << defFileName << endl;
-        cerr << " use: cv value from_unit to_unit " << endl;
+        cerr << " use: cv value from_unit to_unit [param=value ...] " << endl;
+        cerr << "      cv --bin --from unit --to unit [--to unit ...]"
+             << " [--param name file ...] infile outfile [outfile ...] "
+             << endl;
+        cerr << "      cv --npy --from unit --to unit infile [outfile] "
+             << endl;
+        cerr << "      cv --xml --map path from_unit to_unit [--map ...]"
+             << " infile outfile " << endl;
+        cerr << "      cv --cvc-pack outfile name:unit:dtype:file ... "
+             << endl;
+        cerr << "      cv --cvc-list file " << endl;
+        cerr << "      cv --cvc --to unit [--to unit ...] infile [outfile] "
+             << endl;
+        cerr << "      cv --complete prefix [--compatible-with unit] " << endl;
         cerr << " allowed units are: " << endl;
         t = unit_list;
         while ( t )
@@ -171,6 +505,17 @@ int main( int argc, char **argv )
 
           t = t->next;
         }
+        if ( nparam > 0 )
+        {
+          cerr << " parameters are: " << endl;
+          for ( int ip = 0; ip < nparam; ip++ )
+            cerr << " "
+                 << setw(12)
+                 << setiosflags(ios::left)
+                 << param_name[ip]
+                 << param_unit[ip]
+                 << endl;
+        }
         exit ( EXIT_SUCCESS );
   }
 
@@ -178,6 +523,25 @@ int main( int argc, char **argv )
   from_unit = argv[2];
   to_unit = argv[3];
 
+  // parameter values: name=value
+  for ( int i = 4; i < argc; i++ )
+  {
+    char *eq = strchr( argv[i], '=' );
+    int ip = -1;
+    if ( eq )
+    {
+      *eq = '\0';
+      ip = find_param( argv[i] );
+    }
+    if ( ip < 0 )
+    {
+      cerr << " cv: unknown parameter " << argv[i] << endl;
+      exit ( EXIT_FAILURE );
+    }
+    param_given[ip] = TRUE;
+    param_value[ip] = atof( eq+1 );
+  }
+
   result = convert( value, from_unit, to_unit );
 
   cout << " "
@@ -187,6 +551,9 @@ int main( int argc, char **argv )
        << setprecision(8)
        << result << " " << to_unit << endl;
 
+  if ( profile )
+    write_profile( profile );
+
   return ( EXIT_SUCCESS );
 }
 
@@ -205,6 +572,9 @@ void add_node( char *new_name, char *new_long_name )
     t->next = unit_list;
     t->adj_list = NULL;
     t->visited = FALSE;
+    t->comp = -1;
+    t->count = 0;
+    t->nquery = 0;
     t->name = ( char * ) malloc ( (strlen(new_name)+1) * sizeof( char ) );
     strcpy ( t->name, new_name );
     t->long_name = ( char * )
@@ -214,10 +584,12 @@ void add_node( char *new_name, char *new_long_name )
   }
 }
 
-void add_edge( char *name1, double fac12, char *name2, int inversion )
+void add_edge( char *name1, double fac12, char *name2, int inversion,
+               char *param )
 {
   struct node *n1, *n2;
   struct edge *t;
+  int ip = -1;
 
   if ( fac12 == 0.0 )
   {
@@ -239,11 +611,16 @@ void add_edge( char *name1, double fac12, char *name2, int inversion )
     exit ( EXIT_FAILURE );
   }
 
+  if ( param )
+    ip = add_param( param, NULL );
+
   /* add edge to the adjacency lists of n1 and n2 */
   t = ( struct edge * ) malloc ( sizeof( *t ) );
   t->to_node = n2;
   t->factor = fac12;
   t->inverse = inversion;
+  t->param = ip;
+  t->ppow = 1;
   t->next = n1->adj_list;
   n1->adj_list = t;
 
@@ -252,54 +629,169 @@ void add_edge( char *name1, double fac12, char *name2, int inversion )
   if ( !inversion )
   {
     t->factor = 1.0 / fac12;
+    t->ppow = -1;
   }
   else
   {
     t->factor = fac12;
+    t->ppow = 1;
   }
   t->inverse = inversion;
+  t->param = ip;
   t->next = n2->adj_list;
   n2->adj_list = t;
 }
 
+int find_param ( char *name )
+{
+  /* return the index of parameter name, or -1 if not defined */
+  for ( int ip = 0; ip < nparam; ip++ )
+    if ( !strcmp( name, param_name[ip] ) )
+      return ip;
+  return -1;
+}
+
+int add_param ( char *name, char *unit )
+{
+  /* return the index of parameter name, defining it if needed */
+  /* a parameter has no unit unless one is declared */
+  int ip = find_param( name );
+  if ( ip < 0 )
+  {
+    if ( nparam == MAXPARAM )
+    {
+      cerr << " add_param: too many parameters" << endl;
+      exit ( EXIT_FAILURE );
+    }
+    ip = nparam++;
+    strcpy( param_name[ip], name );
+    strcpy( param_unit[ip], CVC_NOUNIT );
+    param_given[ip] = FALSE;
+  }
+  if ( unit )
+  {
+    if ( strcmp( unit, CVC_NOUNIT ) && !find_node( unit, unit_list ) )
+    {
+      cerr << " add_param: unit " << unit << " not found " << endl;
+      exit ( EXIT_FAILURE );
+    }
+    strcpy( param_unit[ip], unit );
+  }
+  return ip;
+}
+
 double convert( double value, char *from_unit, char *to_unit )
 {
+  struct plan p;
+  double *y = &result;
+  double *prm[MAXPARAM];
+
+  make_plan( from_unit, to_unit, &p );
+  for ( int ip = 0; ip < nparam; ip++ )
+    prm[ip] = &param_value[ip];
+  apply_plans( &p, 1, &value, &y, prm, 1 );
+
+  return result;
+}
+
+struct node *find_node ( char *name, struct node *list )
+{
+  /* find node named name in list */
+  struct node *t = list;
+  while ( t && strcmp( name, t->name ) )
+    t = t->next;
+  return t;
+}
+
+void reset_visited ( void )
+{
+  struct node *t = unit_list;
+  while ( t )
+  {
+    t->visited = FALSE;
+    t = t->next;
+  }
+}
+
+int same_file ( char *file1, char *file2 )
+{
+  /* return TRUE if file1 and file2 both exist and are the same file */
+  struct stat st1, st2;
+  if ( stat( file1, &st1 ) || stat( file2, &st2 ) )
+    return FALSE;
+  return st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+}
+
+void make_plan( char *from_unit, char *to_unit, struct plan *p )
+{
+  /* compute the plan converting from_unit to to_unit */
   struct node *fu, *tu;
   fu = find_node( from_unit, unit_list );
   if ( !fu )
   {
-    cerr << " convert: unit " << from_unit << " not found " << endl;
+    cerr << " make_plan: unit " << from_unit << " not found " << endl;
     exit ( EXIT_FAILURE );
   }
   tu = find_node( to_unit, unit_list );
   if ( !tu )
   {
-    cerr << " convert: unit " << to_unit << " not found " << endl;
+    cerr << " make_plan: unit " << to_unit << " not found " << endl;
     exit ( EXIT_FAILURE );
   }
+  fu->nquery++;
+  tu->nquery++;
 
-  /* connect from_unit to to_unit */
-
-  found = FALSE;
-  connect ( fu, tu, value );
-  if ( !found )
+  if ( !find_plan( fu, tu, p ) )
   {
     cerr << " Cannot convert " << from_unit << " to "
              << to_unit << endl;
     exit ( EXIT_FAILURE );
   }
 
-  return result;
+  int ip = missing_param( p );
+  if ( ip >= 0 )
+  {
+    cerr << " Conversion from " << from_unit << " to " << to_unit
+         << " requires parameter " << param_name[ip] << endl;
+    exit ( EXIT_FAILURE );
+  }
+}
+
+int find_plan ( struct node *fu, struct node *tu, struct plan *p )
+{
+  /* search the plan converting fu to tu, return FALSE if there is none */
+  struct plan id;
+
+  reset_visited();
+  found = FALSE;
+  id.factor = 1.0;
+  id.inverse = FALSE;
+  for ( int ip = 0; ip < MAXPARAM; ip++ )
+    id.power[ip] = 0;
+  connect_plan ( fu, tu, id );
+  if ( found )
+    *p = plan_result;
+  return found;
 }
 
-void connect ( struct node *n1, struct node *n2, double val )
+int missing_param ( struct plan *p )
 {
+  /* return the index of a parameter used by p but not given, or -1 */
+  for ( int ip = 0; ip < nparam; ip++ )
+    if ( p->power[ip] != 0 && !param_given[ip] )
+      return ip;
+  return -1;
+}
+
+void connect_plan ( struct node *n1, struct node *n2, struct plan p )
+{
+  /* depth first search from n1 to n2, composing the edges */
   struct edge *t;
+  struct plan q;
 
-  /* Check if destination is reached */
   if ( n1 == n2 )
   {
-    result = val;
+    plan_result = p;
     found = TRUE;
   }
 
@@ -310,30 +802,1357 @@ void connect ( struct node *n1, struct node *n2, double val )
   {
     if ( !t->to_node->visited )
     {
-      /* attempt connection from t->to_node */
       if ( t->inverse )
       {
-        if ( val == 0 )
+        /* factor/(a*x) = (factor/a)/x */
+        q.factor = t->factor / p.factor;
+        q.inverse = !p.inverse;
+        for ( int ip = 0; ip < MAXPARAM; ip++ )
+          q.power[ip] = -p.power[ip];
+      }
+      else
+      {
+        q.factor = t->factor * p.factor;
+        q.inverse = p.inverse;
+        for ( int ip = 0; ip < MAXPARAM; ip++ )
+          q.power[ip] = p.power[ip];
+      }
+      if ( t->param >= 0 )
+        q.power[t->param] += t->ppow;
+      connect_plan ( t->to_node, n2, q );
+    }
+    t = t->next;
+  }
+}
+
+void apply_plans( struct plan *p, int np, const double *x, double **y,
+                  double **prm, long n )
+{
+  /* apply the np plans p to x, writing the results to y[0..np-1] */
+  /* each value of x is loaded once for all plans, so that y[0] == x */
+  /* can be used for an in-place conversion */
+  /* prm[ip] holds the n values of parameter ip used by the plans */
+  int has_param = FALSE;
+  for ( int k = 0; k < np; k++ )
+  {
+    for ( int ip = 0; ip < nparam; ip++ )
+      if ( p[k].power[ip] != 0 )
+        has_param = TRUE;
+  }
+  for ( int k = 0; k < np; k++ )
+  {
+    if ( p[k].inverse )
+    {
+      for ( long i = 0; i < n; i++ )
+      {
+        if ( x[i] == 0 )
         {
           cerr << " Cannot convert zero value " << endl;
           exit ( EXIT_FAILURE );
         }
-        connect ( t->to_node, n2, (t->factor) / val );
       }
-      else
+      break;
+    }
+  }
+
+  if ( !has_param )
+  {
+#pragma omp parallel for
+    for ( long i = 0; i < n; i++ )
+    {
+      const double xi = x[i];
+      for ( int k = 0; k < np; k++ )
+        y[k][i] = p[k].inverse ? p[k].factor / xi : p[k].factor * xi;
+    }
+    return;
+  }
+
+#pragma omp parallel for
+  for ( long i = 0; i < n; i++ )
+  {
+    const double xi = x[i];
+    for ( int k = 0; k < np; k++ )
+    {
+      double s = p[k].factor;
+      for ( int ip = 0; ip < nparam; ip++ )
       {
-        connect ( t->to_node, n2, (t->factor) * val );
+        for ( int m = 0; m < p[k].power[ip]; m++ )
+          s *= prm[ip][i];
+        for ( int m = 0; m > p[k].power[ip]; m-- )
+          s /= prm[ip][i];
       }
+      y[k][i] = p[k].inverse ? s / xi : s * xi;
     }
-    t = t->next;
   }
 }
 
-struct node *find_node ( char *name, struct node *list )
+void convert_bin( char *from_unit, int nto, char **to_units,
+                  char *in_file, char **out_files, char **param_files )
 {
-  /* find node named name in list */
-  struct node *t = list;
-  while ( t && strcmp( name, t->name ) )
+  /* convert a file of native doubles from from_unit to each of the */
+  /* nto units to_units, writing the results to out_files */
+  /* param_files[ip] holds the values of parameter ip if given */
+  struct plan *p;
+  double *buf, **obuf, *pbuf[MAXPARAM];
+  int k, ip, nomem;
+
+  /* an output opened for writing must not truncate an input */
+  for ( k = 0; k < nto; k++ )
+  {
+    int same = same_file( out_files[k], in_file );
+    for ( ip = 0; ip < nparam; ip++ )
+      if ( param_given[ip] && same_file( out_files[k], param_files[ip] ) )
+        same = TRUE;
+    if ( same )
+    {
+      cerr << " convert_bin: output file " << out_files[k]
+           << " is also an input file" << endl;
+      exit ( EXIT_FAILURE );
+    }
+  }
+
+  p = ( struct plan * ) malloc ( nto * sizeof( *p ) );
+  for ( k = 0; k < nto; k++ )
+    make_plan( from_unit, to_units[k], &p[k] );
+
+  buf = ( double * ) malloc ( NCHUNK * sizeof( double ) );
+  obuf = ( double ** ) malloc ( nto * sizeof( double * ) );
+  nomem = !buf || !obuf;
+  for ( k = 0; !nomem && k < nto; k++ )
+  {
+    obuf[k] = ( double * ) malloc ( NCHUNK * sizeof( double ) );
+    if ( !obuf[k] )
+      nomem = TRUE;
+  }
+  for ( ip = 0; ip < nparam; ip++ )
+  {
+    pbuf[ip] = NULL;
+    if ( param_given[ip] )
+    {
+      pbuf[ip] = ( double * ) malloc ( NCHUNK * sizeof( double ) );
+      if ( !pbuf[ip] )
+        nomem = TRUE;
+    }
+  }
+  if ( nomem )
+  {
+    cerr << " convert_bin: cannot allocate buffer" << endl;
+    exit ( EXIT_FAILURE );
+  }
+
+#ifdef USE_MPI
+  int rank, size;
+  MPI_File fin, *fout, fprm[MAXPARAM];
+  MPI_Offset nbytes, pbytes;
+  MPI_Status st;
+  MPI_Init( NULL, NULL );
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+  mype = rank;
+  MPI_Comm_size( MPI_COMM_WORLD, &size );
+
+  if ( MPI_File_open( MPI_COMM_WORLD, in_file, MPI_MODE_RDONLY,
+                      MPI_INFO_NULL, &fin ) != MPI_SUCCESS )
+  {
+    if ( rank == 0 )
+      cerr << " convert_bin: cannot open " << in_file << endl;
+    MPI_Abort( MPI_COMM_WORLD, EXIT_FAILURE );
+  }
+  MPI_File_get_size( fin, &nbytes );
+  if ( nbytes % sizeof(double) )
+  {
+    if ( rank == 0 )
+      cerr << " convert_bin: size of " << in_file
+           << " is not a multiple of " << sizeof(double) << endl;
+    MPI_Abort( MPI_COMM_WORLD, EXIT_FAILURE );
+  }
+  fout = ( MPI_File * ) malloc ( nto * sizeof( MPI_File ) );
+  for ( k = 0; k < nto; k++ )
+  {
+    if ( MPI_File_open( MPI_COMM_WORLD, out_files[k],
+                        MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                        MPI_INFO_NULL, &fout[k] ) != MPI_SUCCESS )
+    {
+      if ( rank == 0 )
+        cerr << " convert_bin: cannot open " << out_files[k] << endl;
+      MPI_Abort( MPI_COMM_WORLD, EXIT_FAILURE );
+    }
+    MPI_File_set_size( fout[k], nbytes );
+  }
+  for ( ip = 0; ip < nparam; ip++ )
+  {
+    if ( !param_given[ip] )
+      continue;
+    if ( MPI_File_open( MPI_COMM_WORLD, param_files[ip], MPI_MODE_RDONLY,
+                        MPI_INFO_NULL, &fprm[ip] ) != MPI_SUCCESS )
+    {
+      if ( rank == 0 )
+        cerr << " convert_bin: cannot open " << param_files[ip] << endl;
+      MPI_Abort( MPI_COMM_WORLD, EXIT_FAILURE );
+    }
+    MPI_File_get_size( fprm[ip], &pbytes );
+    if ( pbytes != nbytes )
+    {
+      if ( rank == 0 )
+        cerr << " convert_bin: sizes of " << param_files[ip]
+             << " and " << in_file << " differ" << endl;
+      MPI_Abort( MPI_COMM_WORLD, EXIT_FAILURE );
+    }
+  }
+
+  // contiguous block distribution of the values among tasks
+  long n = nbytes / sizeof(double);
+  long nloc = n / size + ( rank < n % size ? 1 : 0 );
+  long first = rank * ( n / size ) + ( rank < n % size ? rank : n % size );
+  long nblocks = ( nloc + NCHUNK - 1 ) / NCHUNK;
+  long nblocks_max;
+  // collective calls must be matched on all tasks
+  MPI_Allreduce( &nblocks, &nblocks_max, 1, MPI_LONG, MPI_MAX,
+                 MPI_COMM_WORLD );
+
+  for ( long ib = 0; ib < nblocks_max; ib++ )
+  {
+    long i0 = ib * (long) NCHUNK;
+    int cnt = 0;
+    if ( i0 < nloc )
+      cnt = ( nloc - i0 < NCHUNK ) ? nloc - i0 : NCHUNK;
+    MPI_Offset off = ( first + i0 ) * sizeof(double);
+    MPI_File_read_at_all( fin, off, buf, cnt, MPI_DOUBLE, &st );
+    for ( ip = 0; ip < nparam; ip++ )
+      if ( param_given[ip] )
+        MPI_File_read_at_all( fprm[ip], off, pbuf[ip], cnt, MPI_DOUBLE, &st );
+    apply_plans( p, nto, buf, obuf, pbuf, cnt );
+    for ( k = 0; k < nto; k++ )
+      MPI_File_write_at_all( fout[k], off, obuf[k], cnt, MPI_DOUBLE, &st );
+  }
+
+  MPI_File_close( &fin );
+  for ( k = 0; k < nto; k++ )
+    MPI_File_close( &fout[k] );
+  for ( ip = 0; ip < nparam; ip++ )
+    if ( param_given[ip] )
+      MPI_File_close( &fprm[ip] );
+  free( fout );
+  MPI_Finalize();
+#else
+  FILE *fin, **fout, *fprm[MAXPARAM];
+  struct stat statbuf, pstatbuf;
+  size_t cnt;
+  if ( stat( in_file, &statbuf ) || !( fin = fopen( in_file, "rb" ) ) )
+  {
+    cerr << " convert_bin: cannot open " << in_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  if ( statbuf.st_size % sizeof(double) )
+  {
+    cerr << " convert_bin: size of " << in_file
+         << " is not a multiple of " << sizeof(double) << endl;
+    exit ( EXIT_FAILURE );
+  }
+  fout = ( FILE ** ) malloc ( nto * sizeof( FILE * ) );
+  for ( k = 0; k < nto; k++ )
+  {
+    fout[k] = fopen( out_files[k], "wb" );
+    if ( !fout[k] )
+    {
+      cerr << " convert_bin: cannot open " << out_files[k] << endl;
+      exit ( EXIT_FAILURE );
+    }
+  }
+  for ( ip = 0; ip < nparam; ip++ )
+  {
+    if ( !param_given[ip] )
+      continue;
+    if ( stat( param_files[ip], &pstatbuf ) ||
+         !( fprm[ip] = fopen( param_files[ip], "rb" ) ) )
+    {
+      cerr << " convert_bin: cannot open " << param_files[ip] << endl;
+      exit ( EXIT_FAILURE );
+    }
+    if ( pstatbuf.st_size != statbuf.st_size )
+    {
+      cerr << " convert_bin: sizes of " << param_files[ip]
+           << " and " << in_file << " differ" << endl;
+      exit ( EXIT_FAILURE );
+    }
+  }
+  while ( ( cnt = fread( buf, sizeof(double), NCHUNK, fin ) ) > 0 )
+  {
+    for ( ip = 0; ip < nparam; ip++ )
+    {
+      if ( param_given[ip] &&
+           fread( pbuf[ip], sizeof(double), cnt, fprm[ip] ) != cnt )
+      {
+        cerr << " convert_bin: read error on " << param_files[ip] << endl;
+        exit ( EXIT_FAILURE );
+      }
+    }
+    apply_plans( p, nto, buf, obuf, pbuf, cnt );
+    for ( k = 0; k < nto; k++ )
+    {
+      if ( fwrite( obuf[k], sizeof(double), cnt, fout[k] ) != cnt )
+      {
+        cerr << " convert_bin: write error on " << out_files[k] << endl;
+        exit ( EXIT_FAILURE );
+      }
+    }
+  }
+  fclose( fin );
+  for ( k = 0; k < nto; k++ )
+    fclose( fout[k] );
+  for ( ip = 0; ip < nparam; ip++ )
+    if ( param_given[ip] )
+      fclose( fprm[ip] );
+  free( fout );
+#endif
+  for ( k = 0; k < nto; k++ )
+    free( obuf[k] );
+  free( obuf );
+  for ( ip = 0; ip < nparam; ip++ )
+    free( pbuf[ip] );
+  free( buf );
+  free( p );
+}
+
+void label_component ( struct node *n, int comp )
+{
+  /* assign component id comp to all units connected to n */
+  struct edge *t;
+  n->comp = comp;
+  t = n->adj_list;
+  while ( t )
+  {
+    if ( t->to_node->comp < 0 )
+      label_component ( t->to_node, comp );
     t = t->next;
-  return t;
+  }
+}
+
+int label_components ( void )
+{
+  /* label connected components of the unit graph, return their number */
+  struct node *t;
+  int ncomp = 0;
+  for ( t = unit_list; t; t = t->next )
+    t->comp = -1;
+  for ( t = unit_list; t; t = t->next )
+    if ( t->comp < 0 )
+      label_component ( t, ncomp++ );
+  return ncomp;
+}
+
+int compare_names ( const void *a, const void *b )
+{
+  return strcmp( (*(struct node **) a)->name, (*(struct node **) b)->name );
+}
+
+void complete( char *prefix, char *compat_unit )
+{
+  /* print the names of units starting with prefix, one per line */
+  /* if compat_unit is given, only units convertible to it are printed */
+  struct node *t, *cu = NULL, **index;
+  int n = 0, lo, hi, mid;
+  size_t len = strlen( prefix );
+
+  if ( compat_unit )
+  {
+    cu = find_node( compat_unit, unit_list );
+    if ( !cu )
+      return;
+    label_components();
+  }
+
+  /* sorted name index */
+  for ( t = unit_list; t; t = t->next )
+    n++;
+  index = ( struct node ** ) malloc ( n * sizeof( *index ) );
+  n = 0;
+  for ( t = unit_list; t; t = t->next )
+    index[n++] = t;
+  qsort( index, n, sizeof( *index ), compare_names );
+
+  /* binary search for the first name not less than prefix */
+  lo = 0;
+  hi = n;
+  while ( lo < hi )
+  {
+    mid = ( lo + hi ) / 2;
+    if ( strcmp( index[mid]->name, prefix ) < 0 )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  for ( ; lo < n && !strncmp( index[lo]->name, prefix, len ); lo++ )
+    if ( !cu || index[lo]->comp == cu->comp )
+      cout << index[lo]->name << endl;
+
+  free( index );
+}
+
+void read_counts( char *file )
+{
+  /* set the query counts of the units to the values found in file */
+  FILE *f;
+  char name[32];
+  long count;
+  struct node *t;
+
+  for ( t = unit_list; t; t = t->next )
+    t->count = 0;
+  f = fopen( file, "r" );
+  if ( !f )
+    return;
+  while ( fscanf( f, "%31s %ld", name, &count ) == 2 )
+  {
+    t = find_node( name, unit_list );
+    if ( t )
+      t->count = count;
+  }
+  fclose( f );
+}
+
+void read_profile( char *file )
+{
+  /* read query counts from file and order the unit list by */
+  /* decreasing count, keeping the definition order for equal counts */
+  struct node *t, **list;
+  int n = 0, i, j;
+
+  read_counts( file );
+
+  for ( t = unit_list; t; t = t->next )
+    n++;
+  if ( n == 0 )
+    return;
+  list = ( struct node ** ) malloc ( n * sizeof( *list ) );
+  n = 0;
+  for ( t = unit_list; t; t = t->next )
+    list[n++] = t;
+
+  /* insertion sort: stable, and the list is short */
+  for ( i = 1; i < n; i++ )
+  {
+    t = list[i];
+    for ( j = i; j > 0 && list[j-1]->count < t->count; j-- )
+      list[j] = list[j-1];
+    list[j] = t;
+  }
+
+  for ( i = 0; i < n-1; i++ )
+    list[i]->next = list[i+1];
+  list[n-1]->next = NULL;
+  unit_list = list[0];
+  free( list );
+}
+
+void write_profile( char *file )
+{
+  /* add the queries of this run to the counts in file */
+  /* concurrent runs are serialized with a lock on file.lock; the */
+  /* counts are re-read under the lock, and the new file is written */
+  /* to file.tmp and renamed so that readers never see a partial file */
+  FILE *f;
+  struct node *t;
+  char *lockname, *tmpname;
+  int fd;
+
+  lockname = ( char * ) malloc ( strlen( file ) + 6 );
+  tmpname = ( char * ) malloc ( strlen( file ) + 6 );
+  strcpy( lockname, file );
+  strcat( lockname, ".lock" );
+  strcpy( tmpname, file );
+  strcat( tmpname, ".tmp" );
+
+  fd = open( lockname, O_RDWR | O_CREAT, 0644 );
+  if ( fd < 0 || flock( fd, LOCK_EX ) )
+  {
+    cerr << " cannot lock profile file " << lockname << endl;
+    if ( fd >= 0 )
+      close( fd );
+    free( lockname );
+    free( tmpname );
+    return;
+  }
+
+  read_counts( file );
+  f = fopen( tmpname, "w" );
+  if ( !f )
+    cerr << " cannot write profile file " << tmpname << endl;
+  else
+  {
+    for ( t = unit_list; t; t = t->next )
+    {
+      t->count += t->nquery;
+      if ( t->count > 0 )
+        fprintf( f, "%s %ld\n", t->name, t->count );
+    }
+    if ( fclose( f ) || rename( tmpname, file ) )
+      cerr << " cannot write profile file " << file << endl;
+  }
+
+  flock( fd, LOCK_UN );
+  close( fd );
+  free( lockname );
+  free( tmpname );
+}
+
+int xml_fill ( void )
+{
+  /* refill the input buffer, return 0 at end of file */
+  xml_pos = 0;
+  xml_len = fread( xml_buf, 1, XML_BUFSIZE, xml_in );
+  return xml_len > 0;
+}
+
+int xml_getc ( void )
+{
+  if ( xml_pos == xml_len && !xml_fill() )
+    return EOF;
+  return (unsigned char) xml_buf[xml_pos++];
+}
+
+void xml_putc ( int c )
+{
+  /* append c to the tag/text buffer */
+  if ( xml_tlen == xml_tcap )
+  {
+    xml_tcap = xml_tcap ? 2 * xml_tcap : 4096;
+    xml_tbuf = ( char * ) realloc ( xml_tbuf, xml_tcap + 1 );
+  }
+  xml_tbuf[xml_tlen++] = c;
+}
+
+int xml_text ( int keep )
+{
+  /* read text up to the next '<' or end of file */
+  /* the text is appended to the tag/text buffer if keep is set, */
+  /* otherwise it is copied to the output unchanged */
+  /* return '<' or EOF */
+  char *lt;
+  size_t n;
+  for ( ;; )
+  {
+    if ( xml_pos == xml_len && !xml_fill() )
+      return EOF;
+    lt = ( char * ) memchr( xml_buf+xml_pos, '<', xml_len-xml_pos );
+    n = ( lt ? lt - xml_buf : xml_len ) - xml_pos;
+    if ( keep )
+      for ( size_t i = 0; i < n; i++ )
+        xml_putc( xml_buf[xml_pos+i] );
+    else
+      fwrite( xml_buf+xml_pos, 1, n, xml_out );
+    xml_pos += n;
+    if ( lt )
+    {
+      xml_pos++;
+      return '<';
+    }
+  }
+}
+
+struct xml_map *xml_match ( char *attr )
+{
+  /* return the map matching the current element path and attribute */
+  /* (attr == NULL for element content), or NULL */
+  for ( int im = 0; im < xml_nmaps; im++ )
+  {
+    struct xml_map *m = &xml_maps[im];
+    if ( m->nelem > xml_depth )
+      continue;
+    if ( ( attr == NULL ) != ( m->attr == NULL ) )
+      continue;
+    if ( attr && strcmp( attr, m->attr ) )
+      continue;
+    int j;
+    for ( j = 0; j < m->nelem; j++ )
+      if ( strcmp( m->elem[j], xml_stack[xml_depth-m->nelem+j] ) )
+        break;
+    if ( j == m->nelem )
+      return m;
+  }
+  return NULL;
+}
+
+void xml_convert_text ( char *s, size_t n, struct plan *p )
+{
+  /* write s[0..n-1] to the output, converting numeric tokens with p */
+  /* whitespace is copied unchanged, any other token is an error */
+  /* converted values are written with %.17g so that they round-trip */
+  double *vals;
+  char *end, c;
+  size_t i, j;
+  long nv = 0;
+
+  vals = ( double * ) calloc ( n / 2 + 1, sizeof( double ) );
+  c = s[n];
+  s[n] = '\0';
+  for ( i = 0; i < n; i = j )
+  {
+    for ( j = i; j < n && !isspace( (unsigned char) s[j] ); j++ );
+    if ( j > i )
+    {
+      double v = strtod( s+i, &end );
+      if ( end != s+j )
+      {
+        s[j] = '\0';
+        cerr << " convert_xml: non-numeric value " << s+i
+             << " in converted content" << endl;
+        fclose( xml_out );
+        remove( xml_out_name );
+        exit ( EXIT_FAILURE );
+      }
+      vals[nv++] = v;
+    }
+    for ( ; j < n && isspace( (unsigned char) s[j] ); j++ );
+  }
+
+  if ( nv > 0 )
+    apply_plans( p, 1, vals, &vals, NULL, nv );
+
+  nv = 0;
+  for ( i = 0; i < n; i = j )
+  {
+    for ( j = i; j < n && !isspace( (unsigned char) s[j] ); j++ );
+    if ( j > i )
+      fprintf( xml_out, "%.17g", vals[nv++] );
+    i = j;
+    for ( ; j < n && isspace( (unsigned char) s[j] ); j++ );
+    fwrite( s+i, 1, j-i, xml_out );
+  }
+  s[n] = c;
+  free( vals );
+}
+
+void xml_start_tag ( void )
+{
+  /* process the start tag in the tag buffer and write it to the output */
+  char *s = xml_tbuf, c;
+  size_t i = 1, j, k, n = xml_tlen;
+  struct xml_map *m;
+  int empty = ( n > 2 && s[n-2] == '/' );
+
+  for ( j = i; j < n && !isspace( (unsigned char) s[j] ) &&
+        s[j] != '/' && s[j] != '>'; j++ );
+  if ( xml_depth == XML_MAXDEPTH )
+  {
+    cerr << " convert_xml: elements nested too deeply" << endl;
+    exit ( EXIT_FAILURE );
+  }
+  xml_stack[xml_depth] = ( char * ) malloc ( j - i + 1 );
+  memcpy( xml_stack[xml_depth], s+i, j-i );
+  xml_stack[xml_depth][j-i] = '\0';
+  xml_depth++;
+
+  /* copy the tag, converting the values of mapped attributes */
+  i = 0;
+  while ( j < n )
+  {
+    /* attribute name */
+    for ( ; j < n && ( isspace( (unsigned char) s[j] ) ||
+          s[j] == '/' || s[j] == '>' ); j++ );
+    k = j;
+    for ( ; j < n && s[j] != '=' && !isspace( (unsigned char) s[j] ); j++ );
+    if ( j == n )
+      break;
+    c = s[j];
+    s[j] = '\0';
+    m = xml_match( s+k );
+    s[j] = c;
+    /* attribute value */
+    for ( ; j < n && s[j] != '"' && s[j] != '\''; j++ );
+    if ( j == n )
+      break;
+    c = s[j++];
+    for ( k = j; j < n && s[j] != c; j++ );
+    if ( m )
+    {
+      fwrite( s+i, 1, k-i, xml_out );
+      xml_convert_text( s+k, j-k, &m->p );
+      i = j;
+    }
+    j++;
+  }
+  fwrite( s+i, 1, n-i, xml_out );
+
+  if ( empty )
+    free( xml_stack[--xml_depth] );
+}
+
+void convert_xml( int nmaps, char **paths, char **from_units, char **to_units,
+                  char *in_file, char *out_file )
+{
+  /* copy an XML file, converting the numbers found in the content of */
+  /* the elements or in the attributes given by paths */
+  /* a path is a list of element names separated by '/', matching the */
+  /* innermost elements, optionally followed by @attribute */
+  struct xml_map *active;
+  char *s;
+  int c, prev;
+
+  xml_nmaps = nmaps;
+  xml_maps = ( struct xml_map * ) malloc ( nmaps * sizeof( *xml_maps ) );
+  for ( int im = 0; im < nmaps; im++ )
+  {
+    struct xml_map *m = &xml_maps[im];
+    s = strdup( paths[im] );
+    m->attr = strchr( s, '@' );
+    if ( m->attr )
+      *m->attr++ = '\0';
+    m->nelem = 0;
+    for ( char *e = strtok( s, "/" ); e; e = strtok( NULL, "/" ) )
+    {
+      if ( m->nelem == XML_MAXPATH )
+      {
+        cerr << " convert_xml: path too long: " << paths[im] << endl;
+        exit ( EXIT_FAILURE );
+      }
+      m->elem[m->nelem++] = e;
+    }
+    make_plan( from_units[im], to_units[im], &m->p );
+  }
+
+  /* the output is streamed while the input is read: no in-place mode */
+  if ( same_file( in_file, out_file ) )
+  {
+    cerr << " convert_xml: output file " << out_file
+         << " is the input file" << endl;
+    exit ( EXIT_FAILURE );
+  }
+  xml_in = fopen( in_file, "rb" );
+  if ( !xml_in )
+  {
+    cerr << " convert_xml: cannot open " << in_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  xml_out = fopen( out_file, "wb" );
+  if ( !xml_out )
+  {
+    cerr << " convert_xml: cannot open " << out_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  xml_out_name = out_file;
+  xml_buf = ( char * ) malloc ( XML_BUFSIZE );
+  xml_pos = xml_len = 0;
+  xml_depth = 0;
+
+  active = NULL;
+  for ( ;; )
+  {
+    /* character data */
+    xml_tlen = 0;
+    c = xml_text( active != NULL );
+    if ( active )
+      xml_convert_text( xml_tbuf, xml_tlen, &active->p );
+    if ( c == EOF )
+      break;
+
+    /* markup */
+    xml_tlen = 0;
+    xml_putc( '<' );
+    c = xml_getc();
+    if ( c == '!' || c == '?' )
+    {
+      /* comment, CDATA section, processing instruction or declaration */
+      const char *term = ">";
+      xml_putc( c );
+      if ( c == '?' )
+        term = "?>";
+      else
+      {
+        for ( prev = 0; prev < 2 && ( c = xml_getc() ) != EOF; prev++ )
+        {
+          xml_putc( c );
+          if ( c != "--"[prev] && c != "[C"[prev] )
+            break;
+        }
+        if ( xml_tlen >= 4 && !strncmp( xml_tbuf, "<!--", 4 ) )
+          term = "-->";
+        else if ( xml_tlen >= 4 && !strncmp( xml_tbuf, "<![C", 4 ) )
+          term = "]]>";
+      }
+      size_t lt = strlen( term );
+      while ( !( xml_tlen >= lt + 2 &&
+                 !strncmp( xml_tbuf+xml_tlen-lt, term, lt ) ) )
+      {
+        if ( ( c = xml_getc() ) == EOF )
+          break;
+        xml_putc( c );
+      }
+      fwrite( xml_tbuf, 1, xml_tlen, xml_out );
+      continue;
+    }
+
+    /* start or end tag: read up to '>' outside of quoted values */
+    prev = 0;
+    while ( c != EOF )
+    {
+      xml_putc( c );
+      if ( prev )
+      {
+        if ( c == prev )
+          prev = 0;
+      }
+      else if ( c == '"' || c == '\'' )
+        prev = c;
+      else if ( c == '>' )
+        break;
+      c = xml_getc();
+    }
+    if ( c == EOF )
+    {
+      cerr << " convert_xml: unterminated tag in " << in_file << endl;
+      exit ( EXIT_FAILURE );
+    }
+
+    if ( xml_tbuf[1] == '/' )
+    {
+      fwrite( xml_tbuf, 1, xml_tlen, xml_out );
+      if ( xml_depth > 0 )
+        free( xml_stack[--xml_depth] );
+    }
+    else
+      xml_start_tag();
+    active = xml_match( NULL );
+  }
+
+  fclose( xml_in );
+  if ( fclose( xml_out ) )
+  {
+    cerr << " convert_xml: write error on " << out_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  while ( xml_depth > 0 )
+    free( xml_stack[--xml_depth] );
+  free( xml_buf );
+  free( xml_tbuf );
+  free( xml_maps );
+}
+
+void convert_npy( char *from_unit, char *to_unit,
+                  char *in_file, char *out_file )
+{
+  /* convert the float32 or float64 array of a NumPy .npy file */
+  /* the file is converted in place if out_file is NULL or is the */
+  /* same file as in_file */
+  struct plan p;
+  struct stat statbuf;
+  unsigned char *src, *dst;
+  char *hdr, *s, descr[8];
+  size_t offset, hlen, itemsize, n, shape_n;
+  int fd, fdout, swap, one = 1;
+
+  make_plan( from_unit, to_unit, &p );
+
+  /* opening out_file with O_TRUNC would destroy the input */
+  if ( out_file && same_file( in_file, out_file ) )
+    out_file = NULL;
+
+  fd = open( in_file, out_file ? O_RDONLY : O_RDWR );
+  if ( fd < 0 || fstat( fd, &statbuf ) )
+  {
+    cerr << " convert_npy: cannot open " << in_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  src = ( unsigned char * ) mmap( NULL, statbuf.st_size,
+    out_file ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  if ( statbuf.st_size < 10 || src == MAP_FAILED ||
+       memcmp( src, "\x93NUMPY", 6 ) )
+  {
+    cerr << " convert_npy: " << in_file << " is not a .npy file" << endl;
+    exit ( EXIT_FAILURE );
+  }
+  if ( src[6] < 1 || src[6] > 3 )
+  {
+    cerr << " convert_npy: unsupported .npy version " << (int) src[6]
+         << " in " << in_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  if ( src[6] > 1 && statbuf.st_size < 12 )
+  {
+    cerr << " convert_npy: truncated header in " << in_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+
+  /* header: magic, version, little-endian header length, dict */
+  /* the length has 2 bytes in version 1 and 4 bytes in versions 2, 3 */
+  if ( src[6] == 1 )
+  {
+    hlen = src[8] | src[9] << 8;
+    offset = 10;
+  }
+  else
+  {
+    hlen = src[8] | src[9] << 8 | src[10] << 16 | (size_t) src[11] << 24;
+    offset = 12;
+  }
+  if ( offset + hlen > (size_t) statbuf.st_size )
+  {
+    cerr << " convert_npy: truncated header in " << in_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  hdr = ( char * ) malloc ( hlen + 1 );
+  memcpy( hdr, src+offset, hlen );
+  hdr[hlen] = '\0';
+  offset += hlen;
+
+  s = strstr( hdr, "'descr':" );
+  if ( !s || sscanf( s+8, " '%7[^']'", descr ) != 1 ||
+       ( strcmp( descr+1, "f4" ) && strcmp( descr+1, "f8" ) ) )
+  {
+    cerr << " convert_npy: " << in_file
+         << ": only float32 and float64 arrays are supported" << endl;
+    exit ( EXIT_FAILURE );
+  }
+  itemsize = descr[2] - '0';
+  /* byte order of the data compared to the native byte order */
+  swap = ( descr[0] == '<' && !*(char *) &one ) ||
+         ( descr[0] == '>' && *(char *) &one );
+
+  s = strstr( hdr, "'shape':" );
+  s = s ? strchr( s, '(' ) : NULL;
+  if ( !s )
+  {
+    cerr << " convert_npy: no shape in header of " << in_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  shape_n = 1;
+  for ( s++; *s && *s != ')'; )
+  {
+    if ( isdigit( (unsigned char) *s ) )
+      shape_n *= strtoul( s, &s, 10 );
+    else
+      s++;
+  }
+  free( hdr );
+  n = ( statbuf.st_size - offset ) / itemsize;
+  if ( n < shape_n )
+  {
+    cerr << " convert_npy: " << in_file << " is shorter than its shape"
+         << endl;
+    exit ( EXIT_FAILURE );
+  }
+  n = shape_n;
+
+  if ( out_file )
+  {
+    /* copy the header unchanged, then write the converted payload */
+    fdout = open( out_file, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( fdout < 0 || ftruncate( fdout, offset + n * itemsize ) )
+    {
+      cerr << " convert_npy: cannot open " << out_file << endl;
+      exit ( EXIT_FAILURE );
+    }
+    dst = ( unsigned char * ) mmap( NULL, offset + n * itemsize,
+      PROT_READ | PROT_WRITE, MAP_SHARED, fdout, 0 );
+    if ( dst == MAP_FAILED )
+    {
+      cerr << " convert_npy: cannot map " << out_file << endl;
+      exit ( EXIT_FAILURE );
+    }
+    memcpy( dst, src, offset );
+  }
+  else
+    dst = src;
+
+  convert_array( &p, src+offset, dst+offset, itemsize, swap, NULL, n );
+
+  if ( out_file )
+  {
+    munmap( dst, offset + n * itemsize );
+    close( fdout );
+  }
+  munmap( src, statbuf.st_size );
+  close( fd );
+}
+
+void convert_array( struct plan *p, unsigned char *x, unsigned char *y,
+                    size_t itemsize, int swap, double **prm, size_t n )
+{
+  /* apply plan p to the n float32 or float64 values at x (itemsize */
+  /* 4 or 8, byte-swapped if swap is set), writing the results to y */
+  /* x and y may be equal; prm[ip] holds n float64 parameter values */
+  double *buf, *prm_i[MAXPARAM];
+  buf = ( double * ) malloc ( NCHUNK * sizeof( double ) );
+  for ( size_t i0 = 0; i0 < n; i0 += NCHUNK )
+  {
+    size_t cnt = ( n - i0 < NCHUNK ) ? n - i0 : NCHUNK;
+    unsigned char *xc = x + i0 * itemsize;
+    unsigned char *yc = y + i0 * itemsize;
+    for ( int ip = 0; ip < nparam; ip++ )
+      prm_i[ip] = ( prm && prm[ip] ) ? prm[ip] + i0 : NULL;
+    if ( itemsize == sizeof(double) && !swap )
+    {
+      /* native float64: convert directly from x to y */
+      double *yd = ( double * ) yc;
+      apply_plans( p, 1, ( double * ) xc, &yd, prm_i, cnt );
+      continue;
+    }
+    for ( size_t i = 0; i < cnt; i++ )
+    {
+      unsigned char b[8];
+      for ( size_t j = 0; j < itemsize; j++ )
+        b[j] = xc[i*itemsize + ( swap ? itemsize-1-j : j )];
+      if ( itemsize == 4 )
+      {
+        float f;
+        memcpy( &f, b, 4 );
+        buf[i] = f;
+      }
+      else
+        memcpy( &buf[i], b, 8 );
+    }
+    apply_plans( p, 1, buf, &buf, prm_i, cnt );
+    for ( size_t i = 0; i < cnt; i++ )
+    {
+      unsigned char b[8];
+      if ( itemsize == 4 )
+      {
+        float f = buf[i];
+        memcpy( b, &f, 4 );
+      }
+      else
+        memcpy( b, &buf[i], 8 );
+      for ( size_t j = 0; j < itemsize; j++ )
+        yc[i*itemsize + ( swap ? itemsize-1-j : j )] = b[j];
+    }
+  }
+  free( buf );
+}
+
+void pack_cvc( int ncols, char **specs, char *out_file )
+{
+  /* write a column file from raw arrays given as name:unit:dtype:file */
+  struct cvc_header h;
+  struct cvc_column *col;
+  char **files;
+  struct stat statbuf;
+  FILE *f, *fout;
+  char *buf;
+  size_t cnt;
+
+  col = ( struct cvc_column * ) calloc ( ncols, sizeof( *col ) );
+  files = ( char ** ) malloc ( ncols * sizeof( char * ) );
+  memset( &h, 0, sizeof( h ) );
+  memcpy( h.magic, CVC_MAGIC, 8 );
+  h.byteorder = 1;
+  h.ncols = ncols;
+
+  int64_t offset = sizeof( h ) + ncols * sizeof( *col );
+  for ( int ic = 0; ic < ncols; ic++ )
+  {
+    char *name = specs[ic];
+    char *unit = strchr( name, ':' );
+    char *dtype = unit ? strchr( unit+1, ':' ) : NULL;
+    char *file = dtype ? strchr( dtype+1, ':' ) : NULL;
+    if ( !file )
+    {
+      cerr << " pack_cvc: column must be given as name:unit:dtype:file"
+           << endl;
+      exit ( EXIT_FAILURE );
+    }
+    *unit++ = *dtype++ = *file++ = '\0';
+    if ( strlen( name ) >= CVC_NAMELEN || strlen( unit ) >= CVC_NAMELEN ||
+         ( strcmp( dtype, "f4" ) && strcmp( dtype, "f8" ) ) )
+    {
+      cerr << " pack_cvc: invalid column " << name << endl;
+      exit ( EXIT_FAILURE );
+    }
+    if ( strcmp( unit, CVC_NOUNIT ) && !find_node( unit, unit_list ) )
+    {
+      cerr << " pack_cvc: unit " << unit << " not found " << endl;
+      exit ( EXIT_FAILURE );
+    }
+    int ip = find_param( name );
+    if ( ip >= 0 && strcmp( dtype, "f8" ) )
+    {
+      cerr << " pack_cvc: parameter column " << name << " must be f8"
+           << endl;
+      exit ( EXIT_FAILURE );
+    }
+    if ( ip >= 0 && strcmp( unit, param_unit[ip] ) )
+    {
+      cerr << " pack_cvc: parameter column " << name << " must have unit "
+           << param_unit[ip] << endl;
+      exit ( EXIT_FAILURE );
+    }
+    if ( stat( file, &statbuf ) )
+    {
+      cerr << " pack_cvc: cannot open " << file << endl;
+      exit ( EXIT_FAILURE );
+    }
+    int64_t nrows = statbuf.st_size / ( dtype[1] - '0' );
+    if ( ic == 0 )
+      h.nrows = nrows;
+    if ( nrows != h.nrows || statbuf.st_size % ( dtype[1] - '0' ) )
+    {
+      cerr << " pack_cvc: size of " << file
+           << " does not match the other columns" << endl;
+      exit ( EXIT_FAILURE );
+    }
+    strcpy( col[ic].name, name );
+    strcpy( col[ic].unit, unit );
+    strcpy( col[ic].dtype, dtype );
+    offset = ( offset + CVC_ALIGN - 1 ) / CVC_ALIGN * CVC_ALIGN;
+    col[ic].offset = offset;
+    offset += statbuf.st_size;
+    files[ic] = file;
+  }
+
+  /* opening out_file would truncate a column read from it */
+  for ( int ic = 0; ic < ncols; ic++ )
+  {
+    if ( same_file( out_file, files[ic] ) )
+    {
+      cerr << " pack_cvc: output file " << out_file
+           << " is the source of column " << col[ic].name << endl;
+      exit ( EXIT_FAILURE );
+    }
+  }
+
+  fout = fopen( out_file, "wb" );
+  if ( !fout )
+  {
+    cerr << " pack_cvc: cannot open " << out_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  fwrite( &h, sizeof( h ), 1, fout );
+  fwrite( col, sizeof( *col ), ncols, fout );
+  buf = ( char * ) malloc ( NCHUNK );
+  for ( int ic = 0; ic < ncols; ic++ )
+  {
+    /* pad to the page-aligned offset of the column */
+    for ( long pos = ftell( fout ); pos < col[ic].offset; pos++ )
+      fputc( 0, fout );
+    f = fopen( files[ic], "rb" );
+    if ( !f )
+    {
+      cerr << " pack_cvc: cannot open " << files[ic] << endl;
+      exit ( EXIT_FAILURE );
+    }
+    while ( ( cnt = fread( buf, 1, NCHUNK, f ) ) > 0 )
+      fwrite( buf, 1, cnt, fout );
+    fclose( f );
+  }
+  if ( fclose( fout ) )
+  {
+    cerr << " pack_cvc: write error on " << out_file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  free( buf );
+  free( files );
+  free( col );
+}
+
+unsigned char *map_cvc( char *file, int writable, size_t *size )
+{
+  /* map a column file and check its header and column table */
+  struct stat statbuf;
+  unsigned char *map;
+  struct cvc_header *h;
+  struct cvc_column *col;
+  int fd;
+
+  fd = open( file, writable ? O_RDWR : O_RDONLY );
+  if ( fd < 0 || fstat( fd, &statbuf ) )
+  {
+    cerr << " map_cvc: cannot open " << file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  *size = statbuf.st_size;
+  map = ( unsigned char * ) mmap( NULL, *size,
+    writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0 );
+  close( fd );
+  h = ( struct cvc_header * ) map;
+  if ( *size < sizeof( *h ) || map == MAP_FAILED ||
+       memcmp( h->magic, CVC_MAGIC, 8 ) )
+  {
+    cerr << " map_cvc: " << file << " is not a column file" << endl;
+    exit ( EXIT_FAILURE );
+  }
+  if ( h->byteorder != 1 )
+  {
+    cerr << " map_cvc: " << file << " was written with another byte order"
+         << endl;
+    exit ( EXIT_FAILURE );
+  }
+  col = ( struct cvc_column * ) ( h + 1 );
+  if ( h->ncols < 0 || h->nrows < 0 ||
+       sizeof( *h ) + (uint64_t) h->ncols * sizeof( *col ) > *size )
+  {
+    cerr << " map_cvc: invalid or truncated header in " << file << endl;
+    exit ( EXIT_FAILURE );
+  }
+  uint64_t table_end = sizeof( *h ) + (uint64_t) h->ncols * sizeof( *col );
+  for ( int ic = 0; ic < h->ncols; ic++ )
+  {
+    /* the payload must lie between the column table and the end of */
+    /* the file; lengths are computed in unsigned arithmetic */
+    uint64_t itemsize = col[ic].dtype[1] - '0';
+    uint64_t offset = col[ic].offset;
+    uint64_t nrows = h->nrows;
+    if ( !memchr( col[ic].name, '\0', CVC_NAMELEN ) ||
+         !memchr( col[ic].unit, '\0', CVC_NAMELEN ) ||
+         ( strcmp( col[ic].dtype, "f4" ) && strcmp( col[ic].dtype, "f8" ) )
+         || col[ic].offset < (int64_t) table_end ||
+         col[ic].offset % CVC_ALIGN || offset > *size ||
+         nrows > ( *size - offset ) / itemsize )
+    {
+      cerr << " map_cvc: invalid column " << ic << " in " << file << endl;
+      exit ( EXIT_FAILURE );
+    }
+  }
+  /* payloads of distinct columns must not overlap */
+  for ( int ic = 0; ic < h->ncols; ic++ )
+  {
+    uint64_t end = col[ic].offset + h->nrows * ( col[ic].dtype[1] - '0' );
+    for ( int jc = ic + 1; jc < h->ncols; jc++ )
+    {
+      uint64_t jend = col[jc].offset + h->nrows * ( col[jc].dtype[1] - '0' );
+      if ( h->nrows > 0 &&
+           (uint64_t) col[ic].offset < jend &&
+           (uint64_t) col[jc].offset < end )
+      {
+        cerr << " map_cvc: columns " << ic << " and " << jc
+             << " overlap in " << file << endl;
+        exit ( EXIT_FAILURE );
+      }
+    }
+  }
+  return map;
+}
+
+void list_cvc( char *file )
+{
+  /* print the columns of a column file */
+  size_t size;
+  unsigned char *map = map_cvc( file, FALSE, &size );
+  struct cvc_header *h = ( struct cvc_header * ) map;
+  struct cvc_column *col = ( struct cvc_column * ) ( h + 1 );
+
+  cout << " " << file << ": " << h->nrows << " rows" << endl;
+  for ( int ic = 0; ic < h->ncols; ic++ )
+    cout << " "
+         << setw(16) << setiosflags(ios::left) << col[ic].name
+         << setw(12) << setiosflags(ios::left) << col[ic].unit
+         << col[ic].dtype << endl;
+  munmap( map, size );
+}
+
+void convert_cvc( int nto, char **to_units, char *in_file, char *out_file )
+{
+  /* convert each column of a column file to the first of the units */
+  /* to_units it is proportional to (i.e. without inversion, and with */
+  /* any parameter supplied by a column), and */
+  /* record the new unit in the header; the file is converted in */
+  /* place if out_file is NULL or is the same file as in_file */
+  /* a column named as an edge parameter provides its values and is */
+  /* not converted */
+  size_t size;
+  unsigned char *src, *dst;
+  struct cvc_header *h;
+  struct cvc_column *col, *ocol;
+  struct node *fu, *tu;
+  double *prm[MAXPARAM];
+  struct plan p;
+
+  /* opening out_file with O_TRUNC would destroy the input */
+  if ( out_file && same_file( in_file, out_file ) )
+    out_file = NULL;
+
+  src = map_cvc( in_file, out_file == NULL, &size );
+  h = ( struct cvc_header * ) src;
+  col = ( struct cvc_column * ) ( h + 1 );
+
+  /* parameter columns */
+  for ( int ip = 0; ip < nparam; ip++ )
+  {
+    prm[ip] = NULL;
+    for ( int ic = 0; ic < h->ncols; ic++ )
+    {
+      if ( strcmp( col[ic].name, param_name[ip] ) )
+        continue;
+      if ( strcmp( col[ic].dtype, "f8" ) )
+      {
+        cerr << " convert_cvc: parameter column " << col[ic].name
+             << " must be f8" << endl;
+        exit ( EXIT_FAILURE );
+      }
+      if ( strcmp( col[ic].unit, param_unit[ip] ) )
+      {
+        cerr << " convert_cvc: parameter column " << col[ic].name
+             << " must have unit " << param_unit[ip] << endl;
+        exit ( EXIT_FAILURE );
+      }
+      prm[ip] = ( double * ) ( src + col[ic].offset );
+    }
+    param_given[ip] = prm[ip] != NULL;
+  }
+
+  if ( out_file )
+  {
+    int fd = open( out_file, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( fd < 0 || ftruncate( fd, size ) )
+    {
+      cerr << " convert_cvc: cannot open " << out_file << endl;
+      exit ( EXIT_FAILURE );
+    }
+    dst = ( unsigned char * ) mmap( NULL, size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( dst == MAP_FAILED )
+    {
+      cerr << " convert_cvc: cannot map " << out_file << endl;
+      exit ( EXIT_FAILURE );
+    }
+    memcpy( dst, src, sizeof( *h ) + h->ncols * sizeof( *col ) );
+  }
+  else
+    dst = src;
+  ocol = ( struct cvc_column * ) ( dst + sizeof( *h ) );
+
+  label_components();
+  for ( int ic = 0; ic < h->ncols; ic++ )
+  {
+    unsigned char *x = src + col[ic].offset;
+    unsigned char *y = dst + col[ic].offset;
+    size_t itemsize = col[ic].dtype[1] - '0';
+
+    tu = NULL;
+    fu = find_node( col[ic].unit, unit_list );
+    if ( find_param( col[ic].name ) >= 0 )
+      fu = NULL;
+    for ( int k = 0; fu && !tu && k < nto; k++ )
+    {
+      tu = find_node( to_units[k], unit_list );
+      if ( !tu )
+      {
+        cerr << " convert_cvc: unit " << to_units[k] << " not found "
+             << endl;
+        exit ( EXIT_FAILURE );
+      }
+      /* skip targets reached only through an inversion or through */
+      /* a parameter that has no column */
+      if ( tu->comp != fu->comp )
+        tu = NULL;
+      else if ( tu != fu && ( !find_plan( fu, tu, &p ) || p.inverse ||
+                              missing_param( &p ) >= 0 ) )
+        tu = NULL;
+    }
+
+    if ( !tu || tu == fu )
+    {
+      if ( x != y )
+        memcpy( y, x, h->nrows * itemsize );
+      continue;
+    }
+    fu->nquery++;
+    tu->nquery++;
+    convert_array( &p, x, y, itemsize, FALSE, prm, h->nrows );
+    memset( ocol[ic].unit, 0, CVC_NAMELEN );
+    strcpy( ocol[ic].unit, tu->name );
+  }
+
+  if ( out_file )
+    munmap( dst, size );
+  munmap( src, size );
 }
@@ -0,0 +1,35 @@
+# bash completion for cv
+# source this file, e.g. from ~/.bashrc:  . cv-completion.bash
+# unit names are obtained from cv --complete
+
+_cv()
+{
+  local cur=${COMP_WORDS[COMP_CWORD]}
+  local prev=${COMP_WORDS[COMP_CWORD-1]}
+  local compat="" i
+
+  COMPREPLY=()
+  if [[ $prev == --from ]]; then
+    :
+  elif [[ $prev == --to ]]; then
+    # restrict to units compatible with the --from unit
+    for (( i=1; i<COMP_CWORD-1; i++ )); do
+      [[ ${COMP_WORDS[i]} == --from ]] && compat=${COMP_WORDS[i+1]}
+    done
+  elif [[ ${COMP_WORDS[1]} == --* ]]; then
+    if (( COMP_CWORD == 1 )); then
+      COMPREPLY=( $(compgen -W "--bin --npy --xml --cvc --cvc-pack --cvc-list --complete" -- "$cur") )
+    fi
+    # file arguments: fall back to default completion
+    return
+  elif (( COMP_CWORD == 2 )); then
+    # cv value from_unit to_unit
+    :
+  elif (( COMP_CWORD == 3 )); then
+    compat=${COMP_WORDS[2]}
+  else
+    return
+  fi
+  COMPREPLY=( $(cv --complete "$cur" ${compat:+--compatible-with "$compat"} 2>/dev/null) )
+}
+complete -o default -F _cv cv